@@ -0,0 +1,53 @@
+#include "exporter.hpp"
+#include "simulation.hpp"
+
+
+Exporter::~Exporter() {
+    if (!m_thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+}
+
+
+bool Exporter::open(std::string const& name) {
+    if (!m_writer.open(name)) return false;
+    m_thread = std::thread(&Exporter::run, this);
+    return true;
+}
+
+
+void Exporter::start(Simulation const& sim) {
+    if (!is_open()) return;
+    {
+        // finish the previous export first, or run() would drop this one
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this] { return !m_sim; });
+        m_sim = &sim;
+    }
+    m_cv.notify_all();
+}
+
+
+void Exporter::wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this] { return !m_sim; });
+}
+
+
+void Exporter::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_cv.wait(lock, [this] { return m_sim || m_quit; });
+        if (m_quit) break;
+        Simulation const* sim = m_sim;
+        lock.unlock();
+        sim->publish(m_writer);
+        lock.lock();
+        m_sim = nullptr;
+        m_cv.notify_all();
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "shared_state.hpp"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+
+class Simulation;
+
+
+// publishes the simulation from a helper thread, so the copy into shared
+// memory overlaps with drawing instead of adding to the step.
+class Exporter {
+public:
+    ~Exporter();
+
+    bool open(std::string const& name);
+    bool is_open() const { return m_thread.joinable(); }
+
+    // start publishing sim, after the previous export is done.
+    // sim must not change until wait() returns
+    void start(Simulation const& sim);
+    void wait();
+
+private:
+    void run();
+
+    shared_state::Writer    m_writer;
+    std::thread             m_thread;
+    std::mutex              m_mutex;
+    std::condition_variable m_cv;
+    Simulation const*       m_sim  = nullptr;
+    bool                    m_quit = false;
+};
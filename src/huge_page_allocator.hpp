@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#ifndef __EMSCRIPTEN__
+#include <sys/mman.h>
+#endif
+
+
+// allocator for big simulation fields.
+// allocations of at least one huge page are mmapped, aligned to the huge page
+// size and advised for transparent huge pages, which takes the TLB out of the
+// picture for large grids. smaller ones go through std::allocator.
+template <class T>
+struct HugePageAllocator {
+    using value_type = T;
+
+    enum { HUGE_PAGE_SIZE = 2 << 20 };
+
+    HugePageAllocator() = default;
+    template <class U> HugePageAllocator(HugePageAllocator<U> const&) {}
+
+    static bool is_huge(size_t n) {
+#ifdef __EMSCRIPTEN__
+        return false;
+#else
+        return n * sizeof(T) >= HUGE_PAGE_SIZE;
+#endif
+    }
+
+    T* allocate(size_t n) {
+#ifdef __EMSCRIPTEN__
+        return std::allocator<T>().allocate(n);
+#else
+        if (!is_huge(n)) return std::allocator<T>().allocate(n);
+
+        // over-allocate by one huge page and trim to get the alignment
+        size_t size = round_up(n * sizeof(T));
+        size_t map_size = size + HUGE_PAGE_SIZE;
+        void* p = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) throw std::bad_alloc();
+        char* base    = (char*) p;
+        char* aligned = (char*) round_up((size_t) base);
+        if (aligned > base) munmap(base, aligned - base);
+        munmap(aligned + size, base + map_size - (aligned + size));
+#ifdef MADV_HUGEPAGE
+        madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+        return (T*) aligned;
+#endif
+    }
+
+    void deallocate(T* p, size_t n) {
+#ifdef __EMSCRIPTEN__
+        std::allocator<T>().deallocate(p, n);
+#else
+        if (!is_huge(n)) return std::allocator<T>().deallocate(p, n);
+        munmap(p, round_up(n * sizeof(T)));
+#endif
+    }
+
+private:
+    static size_t round_up(size_t s) {
+        return (s + HUGE_PAGE_SIZE - 1) & ~size_t(HUGE_PAGE_SIZE - 1);
+    }
+};
+
+template <class T, class U>
+bool operator==(HugePageAllocator<T> const&, HugePageAllocator<U> const&) { return true; }
+template <class T, class U>
+bool operator!=(HugePageAllocator<T> const&, HugePageAllocator<U> const&) { return false; }
+
@@ -1,42 +1,125 @@
 #include "simulation.hpp"
+#include "exporter.hpp"
+#include "placement.hpp"
 #include "fx.hpp"
 #include <string>
 #include <chrono>
+#include <array>
+#include <future>
 #include <SDL_image.h>
 #include <SDL.h>
 
 
+namespace {
+
+enum { SCENE_COUNT = 8 };
+
+#ifdef __EMSCRIPTEN__
+auto const ASYNC_POLICY = std::launch::deferred;
+#else
+auto const ASYNC_POLICY = std::launch::async;
+#endif
+
+
+// decode a scene png into the initial state of a simulation
+bool load_scene(int nr, Simulation& sim) {
+    std::string filename = "./scenes/" + std::to_string(nr) + ".png";
+    SDL_Surface* img = IMG_Load(filename.c_str());
+    if (!img) {
+        LOG_ERROR("cannot open %s", filename.c_str());
+        return false;
+    }
+    // don't rely on the png being stored as plain rgb
+    SDL_Surface* rgb = SDL_ConvertSurfaceFormat(img, SDL_PIXELFORMAT_RGB24, 0);
+    SDL_FreeSurface(img);
+    if (!rgb) {
+        LOG_ERROR("cannot convert %s: %s", filename.c_str(), SDL_GetError());
+        return false;
+    }
+    sim.init(rgb->w, rgb->h);
+    for (int y = 0; y < rgb->h; ++y)
+    for (int x = 0; x < rgb->w; ++x) {
+        uint8_t* a = (uint8_t*) rgb->pixels + y * rgb->pitch + x * 3;
+        uint32_t p = (a[0] << 0) | (a[1] << 8) | (a[2] << 16);
+        if (p == 0xffffff) sim.set_solid(x, y, true);
+        if (p == 0xff0000) sim.set_liquid(x, y, true);
+    }
+    SDL_FreeSurface(rgb);
+    return true;
+}
+
+
+} // namespace
+
+
 class Game : public fx::App {
 public:
 
     bool init() override {
-        std::string filename = "./scenes/" + std::to_string(m_scene) + ".png";
-        SDL_Surface* img = IMG_Load(filename.c_str());
-        if (!img) {
-            printf("error: cannot open %s\n", filename.c_str());
+        // IMG_Load initializes lazily, which is not thread safe
+        if (!(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG)) {
+            LOG_ERROR("IMG_Init failed: %s", IMG_GetError());
             return false;
         }
-        m_sim.init(img->w, img->h);
-        for (int y = 0; y < img->h; ++y)
-        for (int x = 0; x < img->w; ++x) {
-            uint8_t* a = (uint8_t*) img->pixels + y * img->pitch + x * 3;
-            uint32_t p = (a[0] << 0) | (a[1] << 8) | (a[2] << 16);
-            if (p == 0xffffff) m_sim.set_solid(x, y, true);
-            if (p == 0xff0000) m_sim.set_liquid(x, y, true);
+        // decode all scenes in the background; switching is then just a copy
+        for (int i = 0; i < SCENE_COUNT; ++i) {
+            m_loading[i] = std::async(ASYNC_POLICY, load_scene, i + 1, std::ref(m_scenes[i]));
+        }
+        return switch_scene(m_scene);
+    }
+    void free() override {
+        for (auto& f : m_loading) {
+            if (f.valid()) f.wait();
+        }
+        IMG_Quit();
+    }
+
+    bool switch_scene(int nr) {
+        int i = nr - 1;
+        // blocks if the scene is still loading
+        if (m_loading[i].valid()) {
+            try {
+                m_loaded[i] = m_loading[i].get();
+            }
+            catch (std::exception const& e) {
+                LOG_ERROR("cannot load scene %d: %s", nr, e.what());
+                m_loaded[i] = false;
+            }
         }
-        SDL_FreeSurface(img);
+        if (!m_loaded[i]) return false;
+        m_export.wait();
+        m_scene = nr;
+        m_sim   = m_scenes[i];
+        update_placement(true);
         return true;
     }
 
+    // pick up the result of the last placement query and maybe start a new
+    // one. the query is slow, so it never runs on this thread
+    void update_placement(bool refresh) {
+        auto& q = m_placement_query;
+        if (q.valid() && q.wait_for(std::chrono::seconds(0)) != std::future_status::timeout) {
+            m_placement = q.get();
+        }
+        if (refresh && !q.valid()) q = std::async(ASYNC_POLICY, query_placement, m_sim.cell_data());
+    }
+
     void update() override {
 
+        // the export must be done with m_sim before it changes again.
+        // it runs while the last frame was drawn, so this should be free,
+        // but if it isn't it holds up the step and is counted as such
+        auto wait_start = std::chrono::high_resolution_clock::now();
+        m_export.wait();
+        auto wait_end = std::chrono::high_resolution_clock::now();
+
         spawn();
 
         // similate & track time
         auto start = std::chrono::high_resolution_clock::now();
         m_sim.simulate();
         auto end = std::chrono::high_resolution_clock::now();
-        m_time_sum     += std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        m_time_sum     += std::chrono::duration_cast<std::chrono::microseconds>(end - start + wait_end - wait_start).count();
         m_time_counter += 1;
         if (m_time_counter >= 60) {
             m_time         = m_time_sum / m_time_counter;
@@ -44,6 +127,10 @@ public:
             m_time_counter = 0;
         }
 
+        m_export.start(m_sim);
+
+        update_placement(m_time_counter == 0);
+
 
         // screenshot
         if (m_recording && m_frame_nr < 60 * 7) {
@@ -58,6 +145,12 @@ public:
         }
         fx::draw_pixels();
         fx::printf(4, 4, "TIME:%6d", m_time);
+        fx::printf(4, 12, "HUGE:%6dK", int(m_placement.huge_bytes >> 10));
+        std::string nodes = "NUMA:";
+        for (size_t i = 0; i < m_placement.node_bytes.size(); ++i) {
+            nodes += " N" + std::to_string(i) + ":" + std::to_string(m_placement.node_bytes[i] >> 10) + "K";
+        }
+        fx::print(4, 20, nodes.c_str());
 
 
         if (m_screenshot) {
@@ -70,9 +163,7 @@ public:
     }
     void key(int code) override {
         if (code >= SDL_SCANCODE_1 && code <= SDL_SCANCODE_8) {
-            m_scene = code - SDL_SCANCODE_1 + 1;
-            m_frame_nr = 0;
-            init();
+            if (switch_scene(code - SDL_SCANCODE_1 + 1)) m_frame_nr = 0;
         }
     }
     void mouse_click(int button, bool state, int x, int y) override {
@@ -125,15 +216,29 @@ public:
     }
 
     void set_recording(bool r) { m_recording = r; }
+    bool set_export(std::string const& name) {
+        if (!m_export.open(name)) {
+            LOG_ERROR("cannot open shared memory %s", name.c_str());
+            return false;
+        }
+        return true;
+    }
 
 private:
     int          m_scene = 1;
     Simulation   m_sim;
 
+    std::array<Simulation, SCENE_COUNT>        m_scenes;
+    std::array<std::future<bool>, SCENE_COUNT> m_loading;
+    std::array<bool, SCENE_COUNT>              m_loaded = {};
+
     int          m_time_counter = 0;
     int          m_time_sum     = 0;
     int          m_time         = 0;
 
+    Placement              m_placement;
+    std::future<Placement> m_placement_query;
+
     int          m_spawn_x;
     int          m_spawn_y;
     bool         m_spawn_enabled = false;
@@ -142,14 +247,26 @@ private:
     bool         m_recording  = false;
     int          m_frame_nr   = 0;
     SDL_Surface* m_screenshot = nullptr;
+
+    Exporter     m_export;
 };
 
 
 
 int main(int argc, char** argv) {
     Game game;
-    if (argc == 2 && std::string(argv[1]) == "--record") {
-        game.set_recording(true);
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--record") {
+            game.set_recording(true);
+        }
+        else if (arg == "--export" && i + 1 < argc) {
+            if (!game.set_export(argv[++i])) return 1;
+        }
+        else {
+            fprintf(stderr, "usage: %s [--record] [--export NAME]\n", argv[0]);
+            return 1;
+        }
     }
     return fx::run(game);
 }
@@ -0,0 +1,57 @@
+// attach to a running liquid with --export and print some live statistics
+#include "shared_state.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+
+int main(int argc, char** argv) {
+    std::string name = argc > 1 ? argv[1] : "/liquid";
+
+    // reattach if the writer is gone or hasn't published for this many polls,
+    // which is what a killed or restarted liquid looks like
+    const int MAX_STALLS = 6;
+
+    shared_state::Reader   reader;
+    shared_state::Snapshot s;
+    uint64_t last_step = 0;
+    int      stalls    = MAX_STALLS;
+    for (;;) {
+        if (stalls >= MAX_STALLS || reader.is_closed()) {
+            reader.close();
+            while (!reader.open(name)) {
+                fprintf(stderr, "waiting for %s...\n", name.c_str());
+                std::this_thread::sleep_for(std::chrono::seconds(1));
+            }
+            last_step = 0;
+            stalls    = 0;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        if (!reader.read(s) || s.step == last_step) {
+            ++stalls;
+            continue;
+        }
+        last_step = s.step;
+        stalls    = 0;
+
+        long  mass  = 0;
+        int   solid = 0;
+        int   wet   = 0;
+        float speed = 0;
+        for (int y = 0; y < s.height; ++y)
+        for (int x = 0; x < s.width; ++x) {
+            int i = x + y * s.width;
+            solid += s.solid[i];
+            if (s.count[i] == 0) continue;
+            mass  += s.count[i];
+            wet   += 1;
+            speed += std::sqrt(s.vx[i] * s.vx[i] + s.vy[i] * s.vy[i]) / s.count[i];
+        }
+        printf("step %8llu  %dx%d  mass %7ld  wet %6d  solid %6d  speed %6.3f\n",
+               (unsigned long long) s.step, s.width, s.height,
+               mass, wet, solid, wet ? speed / wet : 0.0f);
+        fflush(stdout);
+    }
+}
@@ -0,0 +1,60 @@
+#include "placement.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+
+Placement query_placement(void const* p) {
+    Placement placement;
+#ifdef __linux__
+    unsigned long addr  = (unsigned long) p;
+    unsigned long start = 0;
+
+    // smaps: a header line per mapping, followed by its fields.
+    // header lines start with "lo-hi ", field names never contain a '-'
+    std::ifstream smaps("/proc/self/smaps");
+    std::string   line;
+    bool          inside = false;
+    while (std::getline(smaps, line)) {
+        unsigned long lo, hi;
+        char          c;
+        if (sscanf(line.c_str(), "%lx-%lx%c", &lo, &hi, &c) == 3 && c == ' ') {
+            inside = addr >= lo && addr < hi;
+            if (inside) start = lo;
+            continue;
+        }
+        size_t kb;
+        if (inside && sscanf(line.c_str(), "AnonHugePages: %zu kB", &kb) == 1) {
+            placement.huge_bytes = kb << 10;
+            break;
+        }
+    }
+    if (!start) return placement;
+
+    // numa_maps: "start policy key=value ... N<node>=<pages> ... kernelpagesize_kB=<kb>"
+    std::ifstream numa_maps("/proc/self/numa_maps");
+    while (std::getline(numa_maps, line)) {
+        std::istringstream in(line);
+        std::string        word;
+        in >> word;
+        if (strtoul(word.c_str(), nullptr, 16) != start) continue;
+
+        std::vector<size_t> pages;
+        size_t page_kb = 4;
+        while (in >> word) {
+            int    node;
+            size_t n;
+            if (sscanf(word.c_str(), "N%d=%zu", &node, &n) == 2 && node >= 0) {
+                if ((size_t) node >= pages.size()) pages.resize(node + 1);
+                pages[node] = n;
+            }
+            sscanf(word.c_str(), "kernelpagesize_kB=%zu", &page_kb);
+        }
+        for (size_t n : pages) placement.node_bytes.push_back(n * page_kb << 10);
+        break;
+    }
+#endif
+    return placement;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+
+// where the kernel put the memory mapping containing some address
+struct Placement {
+    size_t              huge_bytes = 0; // backed by transparent huge pages
+    std::vector<size_t> node_bytes;     // resident on each numa node
+};
+
+// reads /proc/self/smaps and /proc/self/numa_maps, which makes the kernel
+// walk every mapping's page tables. that can take milliseconds, so keep this
+// off the frame thread. returns an empty placement where this isn't supported.
+Placement query_placement(void const* p);
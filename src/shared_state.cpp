@@ -0,0 +1,181 @@
+#include "shared_state.hpp"
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace shared_state {
+
+
+bool Writer::open(std::string const& name) {
+    close();
+    // start from a fresh segment. readers still attached to a stale one keep
+    // their mapping, which truncating it in place would pull out from under them
+    shm_unlink(name.c_str());
+    m_fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (m_fd < 0) return false;
+    m_name = name;
+    return true;
+}
+
+
+void Writer::close() {
+    if (m_view.header) {
+        // let readers know, and don't leave them waiting for a step to finish
+        Header& h = *m_view.header;
+        h.closed.store(1, std::memory_order_relaxed);
+        uint32_t seq = h.sequence.load(std::memory_order_relaxed);
+        h.sequence.store(seq + 2 - (seq & 1), std::memory_order_release);
+        munmap(m_view.header, segment_size(m_capacity));
+    }
+    if (m_fd >= 0) {
+        // a later writer may have taken over the name; leave its segment alone
+        struct stat ours, named;
+        int fd = shm_open(m_name.c_str(), O_RDONLY, 0);
+        if (fd >= 0) {
+            if (fstat(m_fd, &ours) == 0 && fstat(fd, &named) == 0 &&
+                ours.st_dev == named.st_dev && ours.st_ino == named.st_ino) {
+                shm_unlink(m_name.c_str());
+            }
+            ::close(fd);
+        }
+        ::close(m_fd);
+    }
+    m_fd       = -1;
+    m_capacity = 0;
+    m_view     = {};
+}
+
+
+bool Writer::map(uint32_t capacity) {
+    // only ever grow, so readers' old mappings stay valid
+    if (ftruncate(m_fd, segment_size(capacity)) != 0) return false;
+    void* p = mmap(nullptr, segment_size(capacity), PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (p == MAP_FAILED) return false;
+    if (m_view.header) munmap(m_view.header, segment_size(m_capacity));
+    m_view = make_view(p, capacity);
+
+    Header& h = *m_view.header;
+    if (m_capacity == 0) {
+        h.sequence.store(1, std::memory_order_relaxed);
+        h.closed.store(0, std::memory_order_relaxed);
+        h.step    = 0;
+        h.version = VERSION;
+        h.magic   = MAGIC;
+    }
+    h.capacity = capacity;
+    m_capacity = capacity;
+    return true;
+}
+
+
+View Writer::begin(int width, int height) {
+    if (m_fd < 0) return {};
+    if (m_view.header) {
+        Header& h = *m_view.header;
+        h.sequence.store(h.sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    uint32_t capacity = width * height;
+    if (capacity > m_capacity && !map(capacity)) {
+        close();
+        return {};
+    }
+    Header& h = *m_view.header;
+    h.width  = width;
+    h.height = height;
+    h.step  += 1;
+    return m_view;
+}
+
+
+void Writer::end() {
+    if (!m_view.header) return;
+    Header& h = *m_view.header;
+    h.sequence.store(h.sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+
+bool Reader::open(std::string const& name) {
+    close();
+    m_fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (m_fd < 0) return false;
+    if (!map()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+
+void Reader::close() {
+    if (m_view.header) munmap((void*) m_view.header, m_size);
+    if (m_fd >= 0) ::close(m_fd);
+    m_fd       = -1;
+    m_size     = 0;
+    m_capacity = 0;
+    m_view     = {};
+}
+
+
+bool Reader::map() {
+    if (m_view.header) munmap((void*) m_view.header, m_size);
+    m_view     = {};
+    m_size     = 0;
+    m_capacity = 0;
+
+    struct stat st;
+    if (fstat(m_fd, &st) != 0 || (size_t) st.st_size < sizeof(Header)) return false;
+    void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, m_fd, 0);
+    if (p == MAP_FAILED) return false;
+    m_size = st.st_size;
+
+    Header const& h = *(Header const*) p;
+    uint32_t capacity = h.capacity;
+    if (h.magic != MAGIC || h.version != VERSION || segment_size(capacity) > m_size) {
+        munmap(p, m_size);
+        m_size = 0;
+        return false;
+    }
+    m_view     = make_view((void const*) p, capacity);
+    m_capacity = capacity;
+    return true;
+}
+
+
+bool Reader::read(Snapshot& s) {
+    const int MAX_TRIES = 1000;
+
+    for (int i = 0; i < MAX_TRIES; ++i) {
+        if (!m_view.header && (m_fd < 0 || !map())) return false;
+        if (is_closed()) return false;
+        bool ok = try_read([&](ConstView const& v) {
+            Header const& h = *v.header;
+            s.width  = h.width;
+            s.height = h.height;
+            s.step   = h.step;
+            // the header may be torn, so don't trust it before the checks
+            if (s.width < 0 || s.height < 0) return;
+            if ((size_t) s.width > m_capacity || (size_t) s.height > m_capacity) return;
+            size_t n = (size_t) s.width * (size_t) s.height;
+            if (n > m_capacity) return;
+            s.count.resize(n);
+            s.vx.resize(n);
+            s.vy.resize(n);
+            s.solid.resize(n);
+            memcpy(s.count.data(), v.count, n * sizeof(int32_t));
+            memcpy(s.vx.data(),    v.vx,    n * sizeof(float));
+            memcpy(s.vy.data(),    v.vy,    n * sizeof(float));
+            memcpy(s.solid.data(), v.solid, n);
+        });
+        if (ok) return true;
+        std::this_thread::yield();
+    }
+    return false;
+}
+
+
+} // namespace
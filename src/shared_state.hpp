@@ -0,0 +1,153 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// live simulation state in a named posix shared memory segment.
+// one writer publishes after every step, any number of readers attach to it.
+// a seqlock guards the fields: the writer never waits for a reader, readers
+// retry if a step was published while they were looking.
+namespace shared_state {
+
+    enum : uint32_t {
+        MAGIC   = 0x4451494c, // "LIQD"
+        VERSION = 2,
+    };
+
+    struct Header {
+        uint32_t              magic;
+        uint32_t              version;
+        std::atomic<uint32_t> sequence; // odd while the writer is busy
+        std::atomic<uint32_t> closed;   // set once the writer is gone
+        uint32_t              capacity; // cells the segment has room for
+        int32_t               width;
+        int32_t               height;
+        uint64_t              step;
+    };
+    // the atomics have to work across processes
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "");
+
+    // pointers to the fields, laid out one after the other behind the header
+    struct View {
+        Header*  header;
+        int32_t* count;
+        float*   vx;
+        float*   vy;
+        uint8_t* solid;
+    };
+
+    // what readers get; their mapping is read-only
+    struct ConstView {
+        Header const*  header;
+        int32_t const* count;
+        float const*   vx;
+        float const*   vy;
+        uint8_t const* solid;
+    };
+
+    inline size_t segment_size(uint32_t capacity) {
+        return sizeof(Header) + capacity * (sizeof(int32_t) + 2 * sizeof(float) + 1);
+    }
+
+    inline View make_view(void* base, uint32_t capacity) {
+        View v;
+        v.header = (Header*) base;
+        v.count  = (int32_t*) (v.header + 1);
+        v.vx     = (float*) (v.count + capacity);
+        v.vy     = v.vx + capacity;
+        v.solid  = (uint8_t*) (v.vy + capacity);
+        return v;
+    }
+
+    inline ConstView make_view(void const* base, uint32_t capacity) {
+        View v = make_view(const_cast<void*>(base), capacity);
+        return { v.header, v.count, v.vx, v.vy, v.solid };
+    }
+
+
+    class Writer {
+    public:
+        Writer() = default;
+        Writer(Writer const&) = delete;
+        Writer& operator=(Writer const&) = delete;
+        ~Writer() { close(); }
+
+        bool open(std::string const& name);
+        void close();
+        bool is_open() const { return m_fd >= 0; }
+
+        // fill in the fields between these two
+        View begin(int width, int height);
+        void end();
+
+    private:
+        bool map(uint32_t capacity);
+
+        std::string m_name;
+        int         m_fd       = -1;
+        uint32_t    m_capacity = 0;
+        View        m_view     = {};
+    };
+
+
+    struct Snapshot {
+        int                  width  = 0;
+        int                  height = 0;
+        uint64_t             step   = 0;
+        std::vector<int32_t> count;
+        std::vector<float>   vx;
+        std::vector<float>   vy;
+        std::vector<uint8_t> solid;
+    };
+
+
+    class Reader {
+    public:
+        Reader() = default;
+        Reader(Reader const&) = delete;
+        Reader& operator=(Reader const&) = delete;
+        ~Reader() { close(); }
+
+        bool open(std::string const& name);
+        void close();
+
+        // the writer went away; reopen by name to find its successor
+        bool is_closed() const {
+            return m_view.header && m_view.header->closed.load(std::memory_order_acquire);
+        }
+
+        // call f with a view straight into shared memory.
+        // returns false if the writer got in the way, in which case whatever
+        // f saw is garbage and it should try again.
+        template <class F>
+        bool try_read(F f) {
+            if (!m_view.header || is_closed()) return false;
+            Header const& h = *m_view.header;
+            uint32_t seq = h.sequence.load(std::memory_order_acquire);
+            if (seq & 1) return false;
+            if (h.capacity > m_capacity) {
+                // the writer grew the segment, h is gone after this
+                map();
+                return false;
+            }
+            f(m_view);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return h.sequence.load(std::memory_order_relaxed) == seq;
+        }
+
+        // copy a consistent state, retrying until the writer holds still.
+        // gives up if the writer is closed or stuck in the middle of a step
+        bool read(Snapshot& s);
+
+    private:
+        bool map();
+
+        int       m_fd       = -1;
+        size_t    m_size     = 0;
+        uint32_t  m_capacity = 0;
+        ConstView m_view     = {};
+    };
+}
@@ -1,4 +1,5 @@
 #include "simulation.hpp"
+#include "shared_state.hpp"
 #include <array>
 #include <random>
 
@@ -43,13 +44,71 @@ void Simulation::init(int w, int h) {
 }
 
 
+void Simulation::publish(shared_state::Writer& writer) const {
+    shared_state::View v = writer.begin(m_width, m_height);
+    if (!v.header) return;
+    for (size_t i = 0; i < m_cells.size(); ++i) {
+        Cell const& c = m_cells[i];
+        v.count[i] = c.count;
+        v.vx[i]    = c.vx;
+        v.vy[i]    = c.vy;
+        v.solid[i] = c.solid;
+    }
+    writer.end();
+}
+
+
 void Simulation::simulate() {
     const int NSTEPS = 2;
+    const int NSTEPS_PRESSURE = 6;
 
     apply_flow();
+
+    // Everything after the flow scatter is a chain of row-local stages: each
+    // one reads a cell's 3x3 neighbourhood and writes the d_ fields of that
+    // neighbourhood. So stage k may work on row y as soon as stage k - 1 has
+    // committed row y + 1, and stage k - 1 is done touching everything at or
+    // above that row. Running the stages as a wavefront, LAG rows apart,
+    // keeps the working set to a narrow band of rows that stays in cache,
+    // instead of streaming the whole grid once per stage.
+    // The band is about LAG * stages.size() full rows, so its size grows
+    // with the width: ~320K at 384 wide, but several MB past a few thousand
+    // columns, where it no longer fits in L2. There is no column tiling.
+    std::array<Stage, 1 + NSTEPS * (NSTEPS_PRESSURE + 1)> stages;
+    int n = 0;
+    stages[n++] = Stage::COMMIT_FLOW;
     for (int i = 0; i < NSTEPS; ++i) {
-        resolve_pressure();
-        apply_viscosity();
+        for (int j = 0; j < NSTEPS_PRESSURE; ++j) stages[n++] = Stage::PRESSURE;
+        stages[n++] = Stage::VISCOSITY;
+    }
+
+    const int LAG = 2;
+    for (int t = 0; t <= m_height + LAG * (n - 1); ++t) {
+        for (int k = 0; k < n; ++k) {
+            int y = t - LAG * k;
+            if (y < 0) break;
+            if (y > m_height) continue;
+            run_stage(stages[k], y);
+        }
+    }
+}
+
+
+// process row y and commit row y - 1, which no longer receives any updates.
+// y == m_height only commits the last row.
+void Simulation::run_stage(Stage stage, int y) {
+    switch (stage) {
+    case Stage::COMMIT_FLOW:
+        if (y < m_height) commit_flow(y);
+        break;
+    case Stage::PRESSURE:
+        if (y < m_height) resolve_pressure(y);
+        if (y > 0)        commit_pressure(y - 1);
+        break;
+    case Stage::VISCOSITY:
+        if (y < m_height) apply_viscosity(y);
+        if (y > 0)        commit_viscosity(y - 1);
+        break;
     }
 }
 
@@ -90,8 +149,13 @@ void Simulation::apply_flow() {
         dst.d_vx    += vx;
         dst.d_vy    += vy;
     }
+}
 
-    for (Cell& c : m_cells) {
+
+void Simulation::commit_flow(int y) {
+    Cell* row = &m_cells[y * m_width];
+    for (int x = 0; x < m_width; ++x) {
+        Cell& c = row[x];
         c.count = c.d_count;
         c.vx    = c.d_vx;
         c.vy    = c.d_vy;
@@ -102,48 +166,48 @@ void Simulation::apply_flow() {
 }
 
 
-void Simulation::resolve_pressure() {
-    const int NSTEPS = 6;
+void Simulation::resolve_pressure(int y) {
     float const BUBBLINESS = 0.5f;
 
-    for (int i = 0; i < NSTEPS; ++i) {
-        for (int y = 0; y < m_height; ++y)
-        for (int x = 0; x < m_width; ++x) {
-            Cell& c = m_cells[x + y * m_width];
-
-            for (int j = 0; j < c.count - 1; ++j) {
-
-                // find a random neighbor
-                Offset o = get_random_offset();
-                if (is_solid(x + o.dx, y + o.dy)) continue;
-
-                // transfer liquid
-                Cell& n = m_cells[x + o.dx + (y + o.dy) * m_width];
-                n.d_vx    += c.vx / c.count + o.dx * BUBBLINESS;
-                n.d_vy    += c.vy / c.count + o.dy * BUBBLINESS;
-                n.d_count += 1;
-                c.d_vx    -= c.vx / c.count;
-                c.d_vy    -= c.vy / c.count;
-                c.d_count -= 1;
-            }
-        }
+    for (int x = 0; x < m_width; ++x) {
+        Cell& c = m_cells[x + y * m_width];
+
+        for (int j = 0; j < c.count - 1; ++j) {
 
-        for (Cell& c : m_cells) {
-            c.count += c.d_count;
-            c.vx    += c.d_vx;
-            c.vy    += c.d_vy;
-            c.d_count = 0;
-            c.d_vx    = 0;
-            c.d_vy    = 0;
+            // find a random neighbor
+            Offset o = get_random_offset();
+            if (is_solid(x + o.dx, y + o.dy)) continue;
+
+            // transfer liquid
+            Cell& n = m_cells[x + o.dx + (y + o.dy) * m_width];
+            n.d_vx    += c.vx / c.count + o.dx * BUBBLINESS;
+            n.d_vy    += c.vy / c.count + o.dy * BUBBLINESS;
+            n.d_count += 1;
+            c.d_vx    -= c.vx / c.count;
+            c.d_vy    -= c.vy / c.count;
+            c.d_count -= 1;
         }
     }
 }
 
 
-void Simulation::apply_viscosity() {
+void Simulation::commit_pressure(int y) {
+    Cell* row = &m_cells[y * m_width];
+    for (int x = 0; x < m_width; ++x) {
+        Cell& c = row[x];
+        c.count += c.d_count;
+        c.vx    += c.d_vx;
+        c.vy    += c.d_vy;
+        c.d_count = 0;
+        c.d_vx    = 0;
+        c.d_vy    = 0;
+    }
+}
+
+
+void Simulation::apply_viscosity(int y) {
     int const RADIUS = 1;
 
-    for (int y = 0; y < m_height; ++y)
     for (int x = 0; x < m_width; ++x) {
         Cell& c = m_cells[x + y * m_width];
         if (c.count == 0) continue;
@@ -160,7 +224,13 @@ void Simulation::apply_viscosity() {
         c.d_vx = vx * (c.count / count);
         c.d_vy = vy * (c.count / count);
     }
-    for (Cell& c : m_cells) {
+}
+
+
+void Simulation::commit_viscosity(int y) {
+    Cell* row = &m_cells[y * m_width];
+    for (int x = 0; x < m_width; ++x) {
+        Cell& c = row[x];
         c.vx   = c.d_vx;
         c.vy   = c.d_vy;
         c.d_vx = 0;
@@ -1,12 +1,19 @@
 #pragma once
+#include "huge_page_allocator.hpp"
 #include <vector>
 
 
+namespace shared_state { class Writer; }
+
+
 class Simulation {
 public:
     void init(int w, int h);
     void simulate();
 
+    // export the current state to external readers
+    void publish(shared_state::Writer& writer) const;
+
     void set_solid(int x, int y, bool s) {
         if (!is_valid(x, y)) return;
         m_cells[x + y * m_width] = { s };
@@ -23,6 +30,11 @@ public:
         return cell_at(x, y).count;
     }
 
+    // for asking the kernel where the cells ended up
+    void const* cell_data() const {
+        return m_cells.data();
+    }
+
 private:
 
     struct Cell {
@@ -44,9 +56,16 @@ private:
         return m_cells[y * m_width + x];
     }
 
+    enum class Stage { COMMIT_FLOW, PRESSURE, VISCOSITY };
+
+    void run_stage(Stage stage, int y);
+
     void apply_flow();
-    void resolve_pressure();
-    void apply_viscosity();
+    void commit_flow(int y);
+    void resolve_pressure(int y);
+    void commit_pressure(int y);
+    void apply_viscosity(int y);
+    void commit_viscosity(int y);
 
 
 
@@ -55,8 +74,8 @@ private:
     }
 
 
-    int               m_width;
-    int               m_height;
-    std::vector<Cell> m_cells;
+    int                                         m_width;
+    int                                         m_height;
+    std::vector<Cell, HugePageAllocator<Cell>> m_cells;
 };
 